@@ -73,30 +73,69 @@ typedef struct
 	} symb;
 } drawcalc_symbol_t;
 
+// Compact symbol record (56 bytes instead of 96) encoded once when the symbols are published for drawing
+// Only the anchor point is in double so that deep zooms stay precise, the other points are float offsets from it
+typedef struct
+{
+	xy_t anchor;	// line and rect: first point, quad: p[0], circle: centre, glyph: position
+	union
+	{
+		float off[3][2];	// line and rect: second point, quad: p[1] to p[3]
+		float radius;		// circle
+		struct
+		{
+			float scale;
+			int8_t prec, alig;
+			union
+			{
+				double value;
+				uint64_t v[TEXT_VAL_COUNT];
+			} val;
+		} glyph;	// number and text
+	} symb;
+	float blur;		// lines and quads, 0 for the rest
+	uint16_t col_h[3];	// colour as half floats scaled by 2^col_e, see drawcalc_colour_pack()
+	int8_t col_e;
+	uint8_t type;
+} drawcalc_symbol_prep_t;
+
 typedef struct
 {
 	volatile int thread_on;
 	volatile int32_t inputs_changed;
 	rl_thread_t thread_handle;
-	char *expr_string;
+	rlip_t *prog;
+
+	// Background compilation
+	volatile int comp_on;
+	rl_thread_t comp_thread_handle;
+	char *expr_string, *comp_log;
+	rlip_t *comp_prog;
 	double angle_v, k[5];
 	double angle_next;
 	double time_v, time_next, time_rate_v;
 	int animation;
 
-	drawcalc_symbol_t *symbol0, *symbol1;
-	size_t symbol0_count, symbol0_as, symbol1_count, symbol1_as;
+	drawcalc_symbol_t *symbol0;
+	drawcalc_symbol_prep_t *symbol1, *symbol_prep;
+	size_t symbol0_count, symbol0_as, symbol1_count, symbol1_as, symbol_prep_as;
+	volatile int symbol1_new;
 	rl_mutex_t array_mutex;
 
 	frgb_t colour_cur;
 
 	// Used only by main thread:
-	int recalc;
+	int recalc, edit_pending;
+	double edit_time;
+	drawcalc_symbol_prep_t *symbol_draw;
+	size_t symbol_draw_count, symbol_draw_as;
 } drawcalc_t;
 
 drawcalc_t drawcalc={0};
+int drawcalc_cpu_check_on=0;
 
 #define OPACITY 0.98
+#define DRAWCALC_COMPILE_DEBOUNCE 0.15	// seconds without edits before the formula gets compiled
 
 void drawcalc_compilation_log(char *comp_log)
 {
@@ -144,8 +183,6 @@ void drawcalc_compilation_log(char *comp_log)
 	ctrl_textedit_fromlayout(&layout, 10);
 }
 
-_Thread_local rlip_t drawcalc_prog={0};
-
 size_t drawcalc_alloc_elem()
 {
 	size_t i = drawcalc.symbol0_count;
@@ -254,6 +291,43 @@ double drawcalc_add_text(double x, double y, double scale, double alig, double v
 	return 0.;
 }
 
+// Converts the base98 values of a text symbol to a string (base98 gives 8 chars in 53 bits), returns the string length
+#define DRAWCALC_TEXT_MAX_LEN (8*TEXT_VAL_COUNT)
+
+int drawcalc_text_decode(const uint64_t *val, char *string)
+{
+	const int base = 98;
+	const char base98[98] =
+		"\nabcdefghijklmnopqrstuvwxyz" " _\t"	// 1 = a, 26 = z
+		"0123456789"				// 30 = '0'
+		".:=<>+-*/|"				// 40 - 49
+		",ABCDEFGHIJKLMNOPQRSTUVWXYZ" ";!?"	// 50-79, 51 = A, 76 = Z
+		"\302\260'\"()[]{}"			// 80-81 = °, 82 = ', 83 = "
+		"#$&@\\^`~";				// 90-97
+
+	int iv, ic = 0;
+
+	for (iv=0; iv < TEXT_VAL_COUNT; iv++)
+	{
+		uint64_t v = val[iv];
+
+		while (v)
+		{
+			// Values above 98^8 give more than 8 chars, the string is cut at its maximum length
+			if (ic >= DRAWCALC_TEXT_MAX_LEN)
+				goto terminate_string;
+
+			string[ic] = base98[v % base];
+			ic++;
+			v /= base;
+		}
+	}
+terminate_string:
+	string[ic] = '\0';
+
+	return ic;
+}
+
 typedef struct
 {
 	double *array;
@@ -304,9 +378,8 @@ double rlip_retrieve_val(int64_t store_id, int64_t store_index)
 	return rlip_store[store_id].array[store_index];
 }
 
-void drawcalc_prog_init(drawcalc_t *d, int make_log)
+rlip_t drawcalc_prog_compile(drawcalc_t *d, char *expr_string, buffer_t *comp_log)
 {
-	buffer_t comp_log={0};
 	rlip_inputs_t inputs[] = {
 		RLIP_FUNC,
 		{"colour", drawcalc_set_colour, "fdddd"}, 
@@ -324,36 +397,219 @@ void drawcalc_prog_init(drawcalc_t *d, int make_log)
 		{"cost_of_factor", estimate_cost_of_mul_factor, "fdd"},
 	};
 
+	return rlip_compile(expr_string, inputs, sizeof(inputs)/sizeof(*inputs), 0, comp_log);
+}
+
+int drawcalc_comp_failed(buffer_t *comp_log)
+{
+	return comp_log->buf && comp_log->buf[0];	// only errors are logged
+}
+
+int drawcalc_compile_thread(drawcalc_t *d)
+{
+	buffer_t comp_log={0};
+
 	// Compilation
-	free_rlip(&drawcalc_prog);
-	drawcalc_prog = rlip_compile(d->expr_string, inputs, sizeof(inputs)/sizeof(*inputs), 0, make_log ? &comp_log : NULL);
+	d->comp_prog = calloc(1, sizeof(rlip_t));
+	*d->comp_prog = drawcalc_prog_compile(d, d->expr_string, &comp_log);
 	free_null(&d->expr_string);
-	drawcalc_prog.exec_on = &d->thread_on;
 
-	if (make_log)
+	if (drawcalc_comp_failed(&comp_log))
+	{
+		// The current program keeps drawing
+		free_rlip(d->comp_prog);
+		free_null(&d->comp_prog);
+	}
+	else
 	{
-		drawcalc_compilation_log(comp_log.buf ? comp_log.buf : (uint8_t *) make_string_copy(""));
-
 		// Decompilation
-		buffer_t decomp = rlip_decompile(&drawcalc_prog);
+		buffer_t decomp = rlip_decompile(d->comp_prog);
 		fprintf_rl(stdout, "Decompilation:\n%s\n", decomp.buf);
 		free_buf(&decomp);
 	}
+
+	d->comp_log = comp_log.buf ? (char *) comp_log.buf : make_string_copy("");
+
+	// End thread
+	d->comp_on = 2;
+
+	return 0;
+}
+
+// Half float with subnormals for |f| < 1
+uint16_t drawcalc_float_to_half(float f)
+{
+	uint32_t x, sign;
+
+	memcpy(&x, &f, sizeof(x));
+	sign = (x >> 16) & 0x8000;
+	f = fabsf(f);
+
+	if (f < 6.103515625e-05f)	// subnormal halves are multiples of 2^-24
+		return sign | (uint16_t) lrintf(f * 16777216.f);
+
+	memcpy(&x, &f, sizeof(x));
+	x += 0xFFF + ((x >> 13) & 1);	// round to nearest even
+	return sign | ((x - 0x38000000) >> 13);
+}
+
+float drawcalc_half_to_float(uint16_t h)
+{
+	uint32_t x;
+	float f;
+
+	if ((h & 0x7C00) == 0)
+		f = (h & 0x3FF) * (1.f/16777216.f);
+	else
+	{
+		x = ((h & 0x7FFF) << 13) + 0x38000000;
+		memcpy(&f, &x, sizeof(f));
+	}
+
+	return h & 0x8000 ? -f : f;
+}
+
+// Colours are additive and can be negative, tiny or far above 1, so the half floats are relative to the brightest channel
+void drawcalc_colour_pack(drawcalc_symbol_prep_t *sp, frgb_t c)
+{
+	float cmax = MAXN(fabsf(c.r), MAXN(fabsf(c.g), fabsf(c.b)));
+	int e = 0;
+
+	if (isfinite(cmax) == 0)	// a colour that can't be drawn
+		c.r = c.g = c.b = 0.f;
+	else
+		frexpf(cmax, &e);	// cmax < 2^e
+
+	e = MINN(MAXN(e, -126), 127);
+	sp->col_e = e;
+	sp->col_h[0] = drawcalc_float_to_half(ldexpf(c.r, -e));
+	sp->col_h[1] = drawcalc_float_to_half(ldexpf(c.g, -e));
+	sp->col_h[2] = drawcalc_float_to_half(ldexpf(c.b, -e));
+}
+
+col_t drawcalc_prep_colour(drawcalc_symbol_prep_t *s)
+{
+	return frgb_to_col(make_colour_frgb(ldexpf(drawcalc_half_to_float(s->col_h[0]), s->col_e), ldexpf(drawcalc_half_to_float(s->col_h[1]), s->col_e), ldexpf(drawcalc_half_to_float(s->col_h[2]), s->col_e), 1.));
+}
+
+// World position of point i of a line, rect or quad
+xy_t drawcalc_prep_point(drawcalc_symbol_prep_t *s, int i)
+{
+	if (i == 0)
+		return s->anchor;
+
+	return add_xy(s->anchor, xy(s->symb.off[i-1][0], s->symb.off[i-1][1]));
+}
+
+double drawcalc_prep_edge_radius(drawcalc_symbol_prep_t *s, double scrscale, double thickness)
+{
+	return sqrt(sq(s->blur*scrscale) + sq(thickness));
+}
+
+void drawcalc_prep_set_points(drawcalc_symbol_prep_t *sp, xy_t *p, int count)
+{
+	sp->anchor = p[0];
+	for (int i=1; i < count; i++)
+	{
+		sp->symb.off[i-1][0] = p[i].x - p[0].x;
+		sp->symb.off[i-1][1] = p[i].y - p[0].y;
+	}
+}
+
+void drawcalc_prepare_symbols(drawcalc_symbol_prep_t *prep, drawcalc_symbol_t *symbol, size_t count)
+{
+	for (size_t is=0; is < count; is++)
+	{
+		drawcalc_symbol_t *sym = &symbol[is];
+		drawcalc_symbol_prep_t *sp = &prep[is];
+
+		sp->type = sym->type;
+		sp->blur = 0.f;
+
+		switch (sym->type)
+		{
+			case type_line:
+			{
+				struct line *s = &sym->symb.line;
+				drawcalc_colour_pack(sp, s->col);
+				drawcalc_prep_set_points(sp, (xy_t[]) {s->p0, s->p1}, 2);
+				sp->blur = s->blur;
+				break;
+			}
+
+			case type_rect:
+			{
+				struct rect *s = &sym->symb.rect;
+				drawcalc_colour_pack(sp, s->col);
+				drawcalc_prep_set_points(sp, (xy_t[]) {s->rect.p0, s->rect.p1}, 2);
+				break;
+			}
+
+			case type_quad:
+			{
+				struct quad *s = &sym->symb.quad;
+				drawcalc_colour_pack(sp, s->col);
+				drawcalc_prep_set_points(sp, s->p, 4);
+				sp->blur = s->blur;
+				break;
+			}
+
+			case type_circle:
+			{
+				struct circle *s = &sym->symb.circle;
+				drawcalc_colour_pack(sp, s->col);
+				sp->anchor = s->pos;
+				sp->symb.radius = s->radius;
+				break;
+			}
+
+			case type_number:
+			{
+				struct number *s = &sym->symb.number;
+				drawcalc_colour_pack(sp, s->col);
+				sp->anchor = s->pos;
+				sp->symb.glyph.scale = s->scale;
+				sp->symb.glyph.prec = s->prec;
+				sp->symb.glyph.alig = s->alig;
+				sp->symb.glyph.val.value = s->value;
+				break;
+			}
+
+			case type_text:
+			{
+				struct text *s = &sym->symb.text;
+				drawcalc_colour_pack(sp, s->col);
+				sp->anchor = s->pos;
+				sp->symb.glyph.scale = s->scale;
+				sp->symb.glyph.alig = s->alig;
+				memcpy(sp->symb.glyph.val.v, s->v, sizeof(s->v));
+				break;
+			}
+		}
+	}
+}
+
+void drawcalc_execute(drawcalc_t *d, rlip_t *prog)
+{
+	// Blank the array
+	d->symbol0_count = 0;
+
+	d->colour_cur = make_colour_frgb(3., -1., 2., 1.);
+
+	// Compute all symbols once
+	rlip_execute_opcode(prog);
 }
 
 int drawcalc_thread(drawcalc_t *d)
 {
 	int inputs_changed;
 	double rad, th;
+	drawcalc_symbol_prep_t *prep_swap;
+	size_t as_swap;
 	static double time0=NAN, time1;
 
- 	drawcalc_prog_init(d, 1);
-
 	do
 	{
-		// Blank the array
-		d->symbol0_count = 0;
-
 		d->angle_v = d->angle_next;
 		d->time_v = d->time_next;
 
@@ -371,16 +627,21 @@ int drawcalc_thread(drawcalc_t *d)
 
 		time0 = time1;
 
-		d->colour_cur = make_colour_frgb(3., -1., 2., 1.);
+		drawcalc_execute(d, d->prog);
 
-		// Compute all symbols once
-		rlip_execute_opcode(&drawcalc_prog);
+		// Prepare symbols for drawing then swap them with the drawn ones
+		alloc_enough(&d->symbol_prep, d->symbol0_count, &d->symbol_prep_as, sizeof(drawcalc_symbol_prep_t), 1.2);
+		drawcalc_prepare_symbols(d->symbol_prep, d->symbol0, d->symbol0_count);
 
-		// Copy symbols
 		rl_mutex_lock(&d->array_mutex);
+		prep_swap = d->symbol1;
+		d->symbol1 = d->symbol_prep;
+		d->symbol_prep = prep_swap;
+		as_swap = d->symbol1_as;
+		d->symbol1_as = d->symbol_prep_as;
+		d->symbol_prep_as = as_swap;
 		d->symbol1_count = d->symbol0_count;
-		d->symbol1 = realloc(d->symbol1, d->symbol1_count * sizeof(drawcalc_symbol_t));
-		memcpy(d->symbol1, d->symbol0, d->symbol1_count * sizeof(drawcalc_symbol_t));
+		d->symbol1_new = 1;
 		rl_mutex_unlock(&d->array_mutex);
 
 		// Check loop flag and reset it atomically
@@ -390,7 +651,6 @@ int drawcalc_thread(drawcalc_t *d)
 	} while (inputs_changed && d->thread_on);
 
 	// End thread
-	free_rlip(&drawcalc_prog);
 	d->thread_on = 2;
 
 	return 0;
@@ -549,8 +809,62 @@ void drawcalc_window(drawcalc_t *d, char **form_string, int *form_ret, int *calc
 		draw_dialog_window_fromlayout(&window, NULL, NULL, &layout, *calc_form_detached);
 
 	// Formula processing
-	d->recalc |= *form_ret==1 || *form_ret==4 || (d->inputs_changed && d->thread_on != 1);
-	if (d->recalc)
+	if (*form_ret==1 || *form_ret==4)
+	{
+		d->edit_pending = 1;
+		d->edit_time = get_time_hr();
+	}
+
+	// Take the result of the background compilation
+	if (d->comp_on == 2)
+	{
+		rl_thread_join_and_null(&d->comp_thread_handle);
+		d->comp_on = 0;
+
+		// Discard it if the formula was edited since
+		if (d->edit_pending)
+		{
+			free(d->comp_log);
+			if (d->comp_prog)
+				free_rlip(d->comp_prog);
+			free_null(&d->comp_prog);
+		}
+		else
+		{
+			drawcalc_compilation_log(d->comp_log);
+
+			if (d->comp_prog)
+			{
+				// Stop thread
+				d->thread_on = 0;
+				rl_thread_join_and_null(&d->thread_handle);
+
+				// Replace the program
+				if (d->prog)
+					free_rlip(d->prog);
+				free(d->prog);
+				d->prog = d->comp_prog;
+				d->prog->exec_on = &d->thread_on;
+				d->comp_prog = NULL;
+				d->recalc = 1;
+			}
+		}
+
+		d->comp_log = NULL;
+	}
+
+	// Compile in the background once the edits have stopped for a moment
+	if (d->edit_pending && d->comp_on == 0 && get_time_hr() - d->edit_time >= DRAWCALC_COMPILE_DEBOUNCE)
+	{
+		d->edit_pending = 0;
+		d->expr_string = make_string_copy(*form_string);
+		d->comp_on = 1;
+		rl_thread_create(&d->comp_thread_handle, drawcalc_compile_thread, d);
+	}
+
+	// Execution
+	d->recalc |= d->inputs_changed && d->thread_on != 1;
+	if (d->recalc && d->prog)
 	{
 		d->recalc = 0;
 		d->inputs_changed = 0;
@@ -559,9 +873,6 @@ void drawcalc_window(drawcalc_t *d, char **form_string, int *form_ret, int *calc
 		d->thread_on = 0;
 		rl_thread_join_and_null(&d->thread_handle);
 
-		// Prepare data
-		d->expr_string = make_string_copy(*form_string);
-
 		// Create thread
 		d->thread_on = 1;
 		rl_thread_create(&d->thread_handle, drawcalc_thread, d);
@@ -576,146 +887,1243 @@ void drawcalc_window(drawcalc_t *d, char **form_string, int *form_ret, int *calc
 	window_set_parent_area(drawcalc_time_window, NULL, gui_layout_elem_comp_area_os(&layout, 30, XY0));
 }
 
-void drawing_calculator()
+// CPU tiled rasterizer, used when there's no GPU to run the drawq kernels
+#define DRAWCALC_TILE_SIZE 64
+#define DRAWCALC_GAUSS_EXTENT 3.f	// beyond 3 radii the Gaussian edges are negligible
+#define DRAWCALC_CPU_MT_MIN_SYMB 256	// below this it's not worth waking the workers
+
+// Semaphores and the core count aren't covered by the rl_ threading wrappers, these are the rasteriser's only SDL calls
+typedef SDL_sem *drawcalc_sem_t;
+
+drawcalc_sem_t drawcalc_sem_create()		{ return SDL_CreateSemaphore(0); }
+void drawcalc_sem_destroy(drawcalc_sem_t sem)	{ SDL_DestroySemaphore(sem); }
+void drawcalc_sem_wait(drawcalc_sem_t sem)	{ SDL_SemWait(sem); }
+void drawcalc_sem_post(drawcalc_sem_t sem)	{ SDL_SemPost(sem); }
+int drawcalc_cpu_count()			{ return SDL_GetCPUCount(); }
+
+typedef struct
 {
-	static int init = 1;
-	static rect_t im_display_rect={0};
-	drawcalc_t *d = &drawcalc;
-	static int calc_form_detached=0, comp_log_detached=0, calc_var_detached=0, calc_time_detached=0;
-	static char *form_string=NULL;
-	static int form_ret=0;
-	static ctrl_resize_rect_t range_resize_state={0};
+	xy_t offset, scale;	// pixel = offset + world * scale, scale.y is negative as the Y axis is flipped
+	double thickness;	// radius of the Gaussian edge in pixels, usually drawing_thickness
+} drawcalc_view_t;
 
-	double now = get_time_hr();
+typedef struct
+{
+	uint32_t *index;
+	size_t count, as;
+} drawcalc_tile_bin_t;
 
-	if (init)
-	{
-		init = 0;
+typedef struct
+{
+	drawcalc_tile_bin_t *bin;
+	size_t bin_as;
+	xyi_t tile_count;
+
+	// Current frame
+	drawcalc_symbol_prep_t *symbol;
+	frgb_t *raster;
+	xyi_t dim;
+	drawcalc_view_t view;
+	int next_tile, init;
+	rl_mutex_t tile_mutex;
+
+	// Persistent worker threads, each start_sem post lets one of them help with one frame
+	rl_thread_t *worker;
+	size_t worker_count, worker_as;
+	drawcalc_sem_t start_sem, done_sem;
+	volatile int quit;
+} drawcalc_cpu_raster_t;
+
+drawcalc_view_t drawcalc_view_from_zoom()
+{
+	drawcalc_view_t view;
 
-		rl_mutex_init(&drawcalc.array_mutex);
+	view.offset = sc_xy(XY0);
+	view.scale = sub_xy(sc_xy(xy(1., 1.)), view.offset);
+	view.thickness = drawing_thickness;
 
-		d->angle_next = NAN;
-		d->time_next = NAN;
-		d->time_rate_v = NAN;
-	}
+	return view;
+}
 
-	// Symbol drawing
-	rl_mutex_lock(&d->array_mutex);
-	for (int is=0; is < d->symbol1_count; is++)
-		switch (d->symbol1[is].type)
-		{
-			case type_line:
-			{
-				struct line *s = &drawcalc.symbol1[is].symb.line;
-				draw_line_thin(sc_xy(s->p0), sc_xy(s->p1), sqrt(sq(s->blur*zc.scrscale) + sq(drawing_thickness)), frgb_to_col(s->col), blend_add, 1.);
-				break;
-			}
+xy_t drawcalc_view_xy(drawcalc_view_t view, xy_t p)
+{
+	return add_xy(view.offset, mul_xy(p, view.scale));
+}
 
-			case type_rect:
-			{
-				struct rect *s = &drawcalc.symbol1[is].symb.rect;
-				draw_rect_full(sc_rect(s->rect), drawing_thickness, frgb_to_col(s->col), blend_add, 1.);
-				break;
-			}
+// Pixel position of point i of a symbol from the pixel position of its anchor, the float offset is only scaled so the anchor keeps its precision
+xy_t drawcalc_view_prep_point(drawcalc_view_t view, drawcalc_symbol_prep_t *s, xy_t anchor_pix, int i)
+{
+	if (i == 0)
+		return anchor_pix;
 
-			case type_quad:
-			{
-				struct quad *s = &drawcalc.symbol1[is].symb.quad;
-				draw_polygon_wc(s->p, 4, sqrt(sq(s->blur*zc.scrscale) + sq(drawing_thickness)), frgb_to_col(s->col), blend_add, 1.);
-				break;
-			}
+	return add_xy(anchor_pix, mul_xy(xy(s->symb.off[i-1][0], s->symb.off[i-1][1]), view.scale));
+}
 
-			case type_circle:
-			{
-				struct circle *s = &drawcalc.symbol1[is].symb.circle;
-				draw_circle(FULLCIRCLE, sc_xy(s->pos), s->radius*zc.scrscale, drawing_thickness, frgb_to_col(s->col), blend_add, 1.);
-				break;
-			}
+// Branchless float approximations written so that the row loops below get vectorised
+static inline float drawcalc_fast_exp2f(float x)	// only for x <= 0
+{
+	float f, p, s;
+	int32_t i, e;
+
+	x = 0.5f*(x + 126.f + fabsf(x + 126.f)) - 126.f;	// max(x, -126) without a branch
+	i = (int32_t) x;
+	i -= (float) i > x;					// floor
+	f = x - (float) i;
+	p = 1.f + f*(0.69583356f + f*(0.22606716f + f*0.078024521f));	// 2^f for f in [0 , 1[
+	e = (i + 127) << 23;
+	memcpy(&s, &e, sizeof(s));
+
+	return p * s;
+}
 
-			case type_number:
+static inline float drawcalc_fast_gaussianf(float x)	// exp(-x^2)
+{
+	return drawcalc_fast_exp2f(-1.442695041f * x*x);
+}
+
+static inline float drawcalc_fast_erfrf(float x)	// 0.5 + 0.5*erf(x), Abramowitz & Stegun 7.1.26
+{
+	float ax = fabsf(x), t, p;
+
+	t = 1.f / (1.f + 0.3275911f*ax);
+	p = t*(0.254829592f + t*(-0.284496736f + t*(1.421413741f + t*(-1.453152027f + t*1.061405429f))));
+
+	return 0.5f + copysignf(0.5f - 0.5f*p*drawcalc_fast_gaussianf(ax), x);
+}
+
+static inline float drawcalc_fast_sqrtf(float x)	// only for x >= 0
+{
+	float y;
+	int32_t i;
+
+	// Inverse square root estimate refined by two Newton iterations, sqrtf() isn't vectorised when it has to set errno
+	memcpy(&i, &x, sizeof(i));
+	i = 0x5F375A86 - (i >> 1);
+	memcpy(&y, &i, sizeof(y));
+	y = y * (1.5f - 0.5f*x*y*y);
+	y = y * (1.5f - 0.5f*x*y*y);
+
+	return x * y;
+}
+
+// Pixel bounding box of a symbol including its blurred edge, returns 0 if the symbol isn't rasterised here
+int drawcalc_cpu_symbol_bb(drawcalc_symbol_prep_t *sym, drawcalc_view_t view, rect_t *bb)
+{
+	double scrscale = fabs(view.scale.x), rad;
+	xy_t p, anchor;
+	int i;
+
+	switch (sym->type)
+	{
+		case type_line:
+		case type_rect:
+		case type_quad:
+			anchor = bb->p0 = bb->p1 = drawcalc_view_xy(view, sym->anchor);
+			for (i=1; i < (sym->type==type_quad ? 4 : 2); i++)
 			{
-				struct number *s = &drawcalc.symbol1[is].symb.number;
-				rect_t bounding_rect = make_rect_off(s->pos, mul_xy(xy(20., 1.), set_xy(s->scale * 6.)), xy(0.5, 0.));
-				//draw_rect_full(sc_rect(bounding_rect), drawing_thickness, frgb_to_col(s->col), blend_add, 1.);
-				if (check_box_on_screen(bounding_rect))
-					print_to_screen(s->pos, s->scale, frgb_to_col(s->col), 1., s->alig, "%.*g", (int) s->prec, s->value);
-				break;
+				p = drawcalc_view_prep_point(view, sym, anchor, i);
+				bb->p0 = min_xy(bb->p0, p);
+				bb->p1 = max_xy(bb->p1, p);
 			}
+			break;
 
-			case type_text:
-			{
-				struct text *s = &drawcalc.symbol1[is].symb.text;
-				rect_t bounding_rect = make_rect_off(s->pos, mul_xy(xy(20., 1.), set_xy(s->scale * 6.)), xy(0.5, 0.));
-				if (check_box_on_screen(bounding_rect))
-				{
-					// Convert base98 values to string (base98 gives 8 chars in 53 bits)
-					const int base = 98, char_count = 8;
-					const char base98[98] =
-						"\nabcdefghijklmnopqrstuvwxyz" " _\t"	// 1 = a, 26 = z
-						"0123456789"				// 30 = '0'
-						".:=<>+-*/|"				// 40 - 49
-						",ABCDEFGHIJKLMNOPQRSTUVWXYZ" ";!?"	// 50-79, 51 = A, 76 = Z
-						"\302\260'\"()[]{}"			// 80-81 = °, 82 = ", 83 = '
-						"#$&@\\^`~";				// 90-97
-
-					char string[8*2 + 1];
-					int iv, ic = 0;
-
-					for (iv=0; iv < TEXT_VAL_COUNT; iv++)
-					{
-						uint64_t v = s->v[iv];
-
-						while (v)
-						{
-							string[ic] = base98[v % base];
-							ic++;
-							v /= base;
-
-							if (ic >= 2*char_count)
-							{
-								ic = 2*char_count;
-								goto terminate_string;
-							}
-						}
-					}
-terminate_string:
-					string[ic] = '\0';
+		case type_circle:
+			p = drawcalc_view_xy(view, sym->anchor);
+			bb->p0 = sub_xy(p, set_xy(fabs(sym->symb.radius)*scrscale));
+			bb->p1 = add_xy(p, set_xy(fabs(sym->symb.radius)*scrscale));
+			break;
 
-					print_to_screen(s->pos, s->scale, frgb_to_col(s->col), 1., s->alig, "%s", string);
-				}
-				break;
-			}
-		}
-	rl_mutex_unlock(&d->array_mutex);
-	draw_clamp();
+		default:	// glyphs are left to print_to_screen()
+			return 0;
+	}
 
-	// Windows
-	window_register(1, drawcalc_compilation_log, NULL, RECTNAN, &comp_log_detached, 1, NULL);
-	window_set_parent(drawcalc_compilation_log, NULL, drawcalc_form, NULL);
-	window_register(1, drawcalc_form, NULL, RECTNAN, &calc_form_detached, 3, &form_string, &form_ret, &comp_log_detached);
-	window_set_parent(drawcalc_form, NULL, drawcalc_window, NULL);
-	window_register(1, drawcalc_var_window, NULL, RECTNAN, &calc_var_detached, 1, d);
-	window_set_parent(drawcalc_var_window, NULL, drawcalc_window, NULL);
-	window_register(1, drawcalc_time_window, NULL, RECTNAN, &calc_time_detached, 1, d);
-	window_set_parent(drawcalc_time_window, NULL, drawcalc_window, NULL);
+	rad = drawcalc_prep_edge_radius(sym, scrscale, view.thickness);
+	bb->p0 = sub_xy(bb->p0, set_xy(rad * DRAWCALC_GAUSS_EXTENT));
+	bb->p1 = add_xy(bb->p1, set_xy(rad * DRAWCALC_GAUSS_EXTENT));
 
-	window_register(1, drawcalc_window, NULL, RECTNAN, NULL, 6, d, &form_string, &form_ret, &calc_form_detached, &calc_var_detached, &calc_time_detached);
+	return !(isnan(bb->p0.x) || isnan(bb->p0.y) || isnan(bb->p1.x) || isnan(bb->p1.y));
 }
 
-#ifndef DRAWCALC_AS_A_LIBRARY
-void main_loop()
+void drawcalc_cpu_bin_symbols(drawcalc_cpu_raster_t *cr, drawcalc_symbol_prep_t *symbol, size_t count, xyi_t dim, drawcalc_view_t view)
 {
-	sdl_main_param_t param={0};
-	param.window_name = "Drawing Calculator";
-	param.func = drawing_calculator;
-	param.use_drawq = 1;
-	param.maximise_window = 1;
-	param.gui_toolbar = 1;
-	rl_sdl_standard_main_loop(param);
+	size_t is;
+	int ix, iy;
+	rect_t bb;
+	xyi_t t0, t1;
+
+	cr->tile_count = xyi((dim.x + DRAWCALC_TILE_SIZE-1) / DRAWCALC_TILE_SIZE, (dim.y + DRAWCALC_TILE_SIZE-1) / DRAWCALC_TILE_SIZE);
+	alloc_enough(&cr->bin, cr->tile_count.x*cr->tile_count.y, &cr->bin_as, sizeof(drawcalc_tile_bin_t), 1.);
+	for (ix=0; ix < cr->tile_count.x*cr->tile_count.y; ix++)
+		cr->bin[ix].count = 0;
+
+	for (is=0; is < count; is++)
+	{
+		if (drawcalc_cpu_symbol_bb(&symbol[is], view, &bb) == 0)
+			continue;
+
+		// Skip what's off screen
+		if (bb.p1.x < 0. || bb.p1.y < 0. || bb.p0.x > dim.x-1 || bb.p0.y > dim.y-1)
+			continue;
+
+		t0 = xyi(MAXN(0., bb.p0.x) / DRAWCALC_TILE_SIZE, MAXN(0., bb.p0.y) / DRAWCALC_TILE_SIZE);
+		t1 = xyi(MINN(dim.x-1, bb.p1.x) / DRAWCALC_TILE_SIZE, MINN(dim.y-1, bb.p1.y) / DRAWCALC_TILE_SIZE);
+
+		for (iy=t0.y; iy <= t1.y; iy++)
+			for (ix=t0.x; ix <= t1.x; ix++)
+			{
+				drawcalc_tile_bin_t *b = &cr->bin[iy*cr->tile_count.x + ix];
+				alloc_enough(&b->index, b->count+=1, &b->as, sizeof(uint32_t), 1.5);
+				b->index[b->count-1] = is;
+			}
+	}
 }
 
-int main(int argc, char *argv[])
+// Row kernels, they fill v[] with the symbol's intensity for the n pixels starting at the row's first pixel
+// Everything is float and relative to that first pixel, the setup below computes the row parameters in double so that precision holds at any zoom
+void drawcalc_cpu_row_line(float *restrict v, int n, float a, float ae, float d, float ux, float uy, float ir)
+{
+	// a and ae are the positions along the line relative to its ends, d the distance from the line
+	for (int i=0; i < n; i++)
+		v[i] = drawcalc_fast_gaussianf((d + i*uy) * ir) * (drawcalc_fast_erfrf((a + i*ux) * ir) - drawcalc_fast_erfrf((ae + i*ux) * ir));
+}
+
+void drawcalc_cpu_row_rect(float *restrict v, int n, float a, float b, float vy, float ir)
 {
+	// a and b are the positions relative to the left and right edges
+	for (int i=0; i < n; i++)
+		v[i] = vy * (drawcalc_fast_erfrf((a + i) * ir) - drawcalc_fast_erfrf((b + i) * ir));
+}
+
+void drawcalc_cpu_row_circle(float *restrict v, int n, float pa, float pb, float hc, float dx, float dy2, float radius, float ir)
+{
+	float num, dist;
+
+	// radius - dist = (radius^2 - dist^2) / (radius + dist), with the numerator factored so that it doesn't cancel out near the edge
+	// The tiny term keeps a zero radius circle centred on a pixel from giving 0/0 there
+	for (int i=0; i < n; i++)
+	{
+		num = (pa - i) * (pb + i) + hc;
+		dist = drawcalc_fast_sqrtf(sq(dx + i) + dy2);
+		v[i] = drawcalc_fast_erfrf(num / (radius + dist + 1e-20f) * ir);
+	}
+}
+
+void drawcalc_cpu_row_quad(float *restrict v, int n, const float *a, const float *ae, const float *d, const float *ux, const float *uy, const float *xc, float ir)
+{
+	float d2, dp, ap, aep, dmin, inside;
+	int e, cross;
+
+	for (int i=0; i < n; i++)
+	{
+		dmin = 1e30f;
+		cross = 0;
+
+		for (e=0; e < 4; e++)
+		{
+			// Distance to the edge segment
+			ap = a[e] + i*ux[e];
+			aep = ae[e] + i*ux[e];
+			dp = d[e] + i*uy[e];
+			ap = ap < 0.f ? -ap : 0.f;
+			aep = aep > 0.f ? aep : 0.f;
+			d2 = dp*dp + sq(ap + aep);
+			dmin = d2 < dmin ? d2 : dmin;
+
+			// Even-odd crossing test, xc is where the edge crosses the row or -1e30 if it doesn't
+			cross += i < xc[e];
+		}
+
+		inside = (cross & 1) ? 1.f : -1.f;
+		v[i] = drawcalc_fast_erfrf(inside * drawcalc_fast_sqrtf(dmin) * ir);
+	}
+}
+
+int drawcalc_clamp_to_int(double v, int lo, int hi)	// clamps before converting so that huge pixel coordinates don't overflow
+{
+	return v < lo ? lo : v > hi ? hi : (int) v;
+}
+
+void drawcalc_cpu_raster_tile(drawcalc_cpu_raster_t *cr, int it)
+{
+	drawcalc_tile_bin_t *b = &cr->bin[it];
+	drawcalc_view_t view = cr->view;
+	double scrscale = fabs(view.scale.x), len[4], radius, px, py, ta, h2, h;
+	float v[DRAWCALC_TILE_SIZE], ir, vy, a[4], ae[4], dl[4], ux[4], uy[4], xc[4];
+	int ib, i, j, n, x, y, x0, x1, y0, y1, xs, xe, ys, ye, ec;
+	xy_t p[4], u[4];
+	rect_t r, bb;
+	col_t col;
+	frgb_t *row;
+
+	// Tile limits
+	x0 = (it % cr->tile_count.x) * DRAWCALC_TILE_SIZE;
+	y0 = (it / cr->tile_count.x) * DRAWCALC_TILE_SIZE;
+	x1 = MINN(x0 + DRAWCALC_TILE_SIZE, cr->dim.x) - 1;
+	y1 = MINN(y0 + DRAWCALC_TILE_SIZE, cr->dim.y) - 1;
+
+	for (ib=0; ib < b->count; ib++)
+	{
+		drawcalc_symbol_prep_t *sym = &cr->symbol[b->index[ib]];
+		drawcalc_cpu_symbol_bb(sym, view, &bb);
+
+		// Clip the symbol's bounding box to the tile
+		xs = drawcalc_clamp_to_int(ceil(bb.p0.x), x0, x1+1);
+		xe = drawcalc_clamp_to_int(floor(bb.p1.x), x0-1, x1);
+		ys = drawcalc_clamp_to_int(ceil(bb.p0.y), y0, y1+1);
+		ye = drawcalc_clamp_to_int(floor(bb.p1.y), y0-1, y1);
+		if (xs > xe || ys > ye)
+			continue;
+		n = xe - xs + 1;
+
+		col = drawcalc_prep_colour(sym);
+		ir = 1. / drawcalc_prep_edge_radius(sym, scrscale, view.thickness);
+		radius = fabs(sym->symb.radius) * scrscale;
+
+		// Pixel positions and unit direction of each edge
+		ec = sym->type==type_quad ? 4 : sym->type==type_line;
+		p[0] = drawcalc_view_xy(view, sym->anchor);
+		for (i=1; i < (sym->type==type_quad ? 4 : sym->type==type_circle ? 1 : 2); i++)
+			p[i] = drawcalc_view_prep_point(view, sym, p[0], i);
+		for (i=0; i < ec; i++)
+		{
+			j = (i+1) & 3;
+			u[i] = sub_xy(p[j], p[i]);
+			len[i] = hypot(u[i].x, u[i].y);
+			u[i] = len[i] > 0. ? mul_xy(u[i], set_xy(1./len[i])) : xy(1., 0.);
+			ux[i] = u[i].x;
+			uy[i] = u[i].y;
+		}
+		r.p0 = min_xy(p[0], p[1]);
+		r.p1 = max_xy(p[0], p[1]);
+
+		for (y=ys; y <= ye; y++)
+		{
+			// Row parameters in double relative to pixel (xs, y), then the float kernels
+			switch (sym->type)
+			{
+				case type_line:
+				case type_quad:
+					for (i=0; i < ec; i++)
+					{
+						j = (i+1) & 3;
+						px = xs - p[i].x;
+						py = y - p[i].y;
+						ta = px*u[i].x + py*u[i].y;
+						a[i] = ta;
+						ae[i] = ta - len[i];
+						dl[i] = px*u[i].y - py*u[i].x;
+
+						// Where the edge crosses the row
+						xc[i] = -1e30f;
+						if ((p[i].y > y) != (p[j].y > y))
+							xc[i] = MINN(p[i].x + (p[j].x - p[i].x) * (y - p[i].y) / (p[j].y - p[i].y) - xs, 1e30);
+					}
+
+					if (sym->type == type_line)
+						drawcalc_cpu_row_line(v, n, a[0], ae[0], dl[0], ux[0], uy[0], ir);
+					else
+						drawcalc_cpu_row_quad(v, n, a, ae, dl, ux, uy, xc, ir);
+					break;
+
+				case type_rect:
+					vy = drawcalc_fast_erfrf((y - r.p0.y) * ir) - drawcalc_fast_erfrf((y - r.p1.y) * ir);
+					drawcalc_cpu_row_rect(v, n, xs - r.p0.x, xs - r.p1.x, vy, ir);
+					break;
+
+				case type_circle:
+					px = xs - p[0].x;
+					py = y - p[0].y;
+					h2 = sq(radius) - sq(py);
+					if (h2 >= 0.)
+					{
+						h = sqrt(h2);
+						drawcalc_cpu_row_circle(v, n, h - px, h + px, 0.f, px, sq(py), radius, ir);
+					}
+					else
+						drawcalc_cpu_row_circle(v, n, -px, px, h2, px, sq(py), radius, ir);
+					break;
+			}
+
+			// Additive blending
+			row = &cr->raster[y*cr->dim.x + xs];
+			for (x=0; x < n; x++)
+			{
+				row[x].r += col.r * v[x];
+				row[x].g += col.g * v[x];
+				row[x].b += col.b * v[x];
+			}
+		}
+	}
+}
+
+void drawcalc_cpu_raster_tiles(drawcalc_cpu_raster_t *cr)
+{
+	int it;
+
+	// Tiles are handed out one at a time so that dense areas get shared
+	while (1)
+	{
+		rl_mutex_lock(&cr->tile_mutex);
+		it = cr->next_tile++;
+		rl_mutex_unlock(&cr->tile_mutex);
+
+		if (it >= cr->tile_count.x*cr->tile_count.y)
+			break;
+
+		drawcalc_cpu_raster_tile(cr, it);
+	}
+}
+
+int drawcalc_cpu_worker(drawcalc_cpu_raster_t *cr)
+{
+	while (1)
+	{
+		drawcalc_sem_wait(cr->start_sem);
+		if (cr->quit)
+			break;
+
+		drawcalc_cpu_raster_tiles(cr);
+		drawcalc_sem_post(cr->done_sem);
+	}
+
+	return 0;
+}
+
+// Adds the lines, rects, quads and circles of symbol to an frgb raster, text and numbers must be printed separately
+void drawcalc_cpu_render(drawcalc_cpu_raster_t *cr, drawcalc_symbol_prep_t *symbol, size_t count, frgb_t *raster, xyi_t dim, drawcalc_view_t view, int thread_count)
+{
+	int i;
+
+	if (count == 0 || dim.x <= 0 || dim.y <= 0)
+		return;
+
+	drawcalc_cpu_bin_symbols(cr, symbol, count, dim, view);
+
+	if (thread_count <= 0)
+		thread_count = drawcalc_cpu_count();
+	if (count < DRAWCALC_CPU_MT_MIN_SYMB)
+		thread_count = 1;
+	thread_count = MINN(MAXN(1, thread_count), cr->tile_count.x*cr->tile_count.y);
+
+	// Start the missing workers, they stay around for the next frames
+	if (cr->init == 0)
+	{
+		cr->init = 1;
+		rl_mutex_init(&cr->tile_mutex);
+		cr->start_sem = drawcalc_sem_create();
+		cr->done_sem = drawcalc_sem_create();
+	}
+
+	while (cr->worker_count < thread_count-1)
+	{
+		alloc_enough(&cr->worker, cr->worker_count+1, &cr->worker_as, sizeof(rl_thread_t), 2.);
+		rl_thread_create(&cr->worker[cr->worker_count], drawcalc_cpu_worker, cr);
+		cr->worker_count++;
+	}
+
+	cr->symbol = symbol;
+	cr->raster = raster;
+	cr->dim = dim;
+	cr->view = view;
+	cr->next_tile = 0;
+
+	// The calling thread works on tiles too
+	for (i=1; i < thread_count; i++)
+		drawcalc_sem_post(cr->start_sem);
+	drawcalc_cpu_raster_tiles(cr);
+	for (i=1; i < thread_count; i++)
+		drawcalc_sem_wait(cr->done_sem);
+}
+
+void drawcalc_cpu_raster_free(drawcalc_cpu_raster_t *cr)
+{
+	int i;
+
+	cr->quit = 1;
+	for (i=0; i < cr->worker_count; i++)
+		drawcalc_sem_post(cr->start_sem);
+	for (i=0; i < cr->worker_count; i++)
+		rl_thread_join_and_null(&cr->worker[i]);
+	free_null(&cr->worker);
+
+	if (cr->init)
+	{
+		drawcalc_sem_destroy(cr->start_sem);
+		drawcalc_sem_destroy(cr->done_sem);
+	}
+
+	for (i=0; i < cr->bin_as; i++)
+		free(cr->bin[i].index);
+	free_null(&cr->bin);
+	memset(cr, 0, sizeof(drawcalc_cpu_raster_t));
+}
+
+// Draws the symbols with rouziclib's draw calls, shapes being lines, rects, quads and circles and glyphs being numbers and text
+void drawcalc_draw_symbols(drawcalc_symbol_prep_t *symbol, size_t count, int shapes, int glyphs)
+{
+	for (int is=0; is < count; is++)
+	{
+		drawcalc_symbol_prep_t *s = &symbol[is];
+
+		if (s->type < type_number ? shapes==0 : glyphs==0)
+			continue;
+
+		col_t col = drawcalc_prep_colour(s);
+		switch (s->type)
+		{
+			case type_line:
+				draw_line_thin(sc_xy(s->anchor), sc_xy(drawcalc_prep_point(s, 1)), drawcalc_prep_edge_radius(s, zc.scrscale, drawing_thickness), col, blend_add, 1.);
+				break;
+
+			case type_rect:
+				draw_rect_full(sc_rect(rect(s->anchor, drawcalc_prep_point(s, 1))), drawing_thickness, col, blend_add, 1.);
+				break;
+
+			case type_quad:
+			{
+				xy_t p[4];
+				for (int i=0; i < 4; i++)
+					p[i] = drawcalc_prep_point(s, i);
+				draw_polygon_wc(p, 4, drawcalc_prep_edge_radius(s, zc.scrscale, drawing_thickness), col, blend_add, 1.);
+				break;
+			}
+
+			case type_circle:
+				draw_circle(FULLCIRCLE, sc_xy(s->anchor), s->symb.radius*zc.scrscale, drawing_thickness, col, blend_add, 1.);
+				break;
+
+			case type_number:
+			{
+				xy_t pos = s->anchor;
+				rect_t bounding_rect = make_rect_off(pos, mul_xy(xy(20., 1.), set_xy(s->symb.glyph.scale * 6.)), xy(0.5, 0.));
+				//draw_rect_full(sc_rect(bounding_rect), drawing_thickness, col, blend_add, 1.);
+				if (check_box_on_screen(bounding_rect))
+					print_to_screen(pos, s->symb.glyph.scale, col, 1., s->symb.glyph.alig, "%.*g", (int) s->symb.glyph.prec, s->symb.glyph.val.value);
+				break;
+			}
+
+			case type_text:
+			{
+				xy_t pos = s->anchor;
+				rect_t bounding_rect = make_rect_off(pos, mul_xy(xy(20., 1.), set_xy(s->symb.glyph.scale * 6.)), xy(0.5, 0.));
+				if (check_box_on_screen(bounding_rect))
+				{
+					char string[DRAWCALC_TEXT_MAX_LEN + 1];
+					drawcalc_text_decode(s->symb.glyph.val.v, string);
+
+					print_to_screen(pos, s->symb.glyph.scale, col, 1., s->symb.glyph.alig, "%s", string);
+				}
+				break;
+			}
+		}
+	}
+}
+
+// Draws the shapes through rouziclib's software path and through the tiled rasteriser and compares them one primitive type at a time
+// A pixel passes if |tiled - rouziclib| <= DRAWCALC_CPU_TOL_ABS + DRAWCALC_CPU_TOL_REL * |rouziclib|, for each channel
+#define DRAWCALC_CPU_TOL_ABS 0.004	// about one 8-bit step of a pixel of brightness 1
+#define DRAWCALC_CPU_TOL_REL 0.01
+
+int drawcalc_cpu_check(drawcalc_cpu_raster_t *cr, drawcalc_symbol_prep_t *symbol, size_t count)
+{
+	const char *type_name[] = {"line", "rect", "quad", "circle"};
+	size_t i, is, type_count, pix_count = (size_t) fb->w * fb->h, fail_pix;
+	frgb_t *saved, *rl_raster;
+	drawcalc_symbol_prep_t *typed;
+	float diff, diff_max, rel_max, *a, *b;
+	int type, ic, pass=1;
+
+	saved = calloc(pix_count, sizeof(frgb_t));
+	rl_raster = calloc(pix_count, sizeof(frgb_t));
+	typed = calloc(count, sizeof(drawcalc_symbol_prep_t));
+	memcpy(saved, fb->r.f, pix_count * sizeof(frgb_t));
+
+	for (type=type_line; type <= type_circle; type++)
+	{
+		// Symbols of this type only, so that an error can be traced to its kernel
+		for (type_count=0, is=0; is < count; is++)
+			if (symbol[is].type == type)
+				typed[type_count++] = symbol[is];
+
+		if (type_count == 0)
+			continue;
+
+		memset(fb->r.f, 0, pix_count * sizeof(frgb_t));
+		drawcalc_draw_symbols(typed, type_count, 1, 0);
+		memcpy(rl_raster, fb->r.f, pix_count * sizeof(frgb_t));
+
+		memset(fb->r.f, 0, pix_count * sizeof(frgb_t));
+		drawcalc_cpu_render(cr, typed, type_count, fb->r.f, xyi(fb->w, fb->h), drawcalc_view_from_zoom(), 0);
+
+		diff_max = rel_max = 0.f;
+		fail_pix = 0;
+		for (i=0; i < pix_count; i++)
+		{
+			a = &fb->r.f[i].r;
+			b = &rl_raster[i].r;
+			for (ic=0; ic < 3; ic++)
+			{
+				diff = fabsf(a[ic] - b[ic]);
+				diff_max = MAXN(diff_max, diff);
+				rel_max = MAXN(rel_max, diff / MAXN(fabsf(b[ic]), 1e-3f));
+				if ((diff <= DRAWCALC_CPU_TOL_ABS + DRAWCALC_CPU_TOL_REL * fabsf(b[ic])) == 0)	// also catches NaN
+				{
+					fail_pix++;
+					break;
+				}
+			}
+		}
+
+		pass &= fail_pix == 0;
+		fprintf_rl(stdout, "CPU tiled rasteriser vs rouziclib, %zu %ss: max abs difference %g, max relative difference %g, %zu pixels out of tolerance, %s\n",
+				type_count, type_name[type], diff_max, rel_max, fail_pix, fail_pix ? "FAIL" : "pass");
+	}
+
+	memcpy(fb->r.f, saved, pix_count * sizeof(frgb_t));
+	free(saved);
+	free(rl_raster);
+	free(typed);
+
+	return pass;
+}
+
+void drawing_calculator()
+{
+	static int init = 1;
+	static rect_t im_display_rect={0};
+	drawcalc_t *d = &drawcalc;
+	static int calc_form_detached=0, comp_log_detached=0, calc_var_detached=0, calc_time_detached=0;
+	static char *form_string=NULL;
+	static int form_ret=0;
+	static ctrl_resize_rect_t range_resize_state={0};
+	static drawcalc_cpu_raster_t cpu_raster={0};
+	int cpu_tiled, symbol_new;
+
+	double now = get_time_hr();
+
+	if (init)
+	{
+		init = 0;
+
+		rl_mutex_init(&drawcalc.array_mutex);
+
+		d->angle_next = NAN;
+		d->time_next = NAN;
+		d->time_rate_v = NAN;
+	}
+
+	// Take the latest symbols if there are new ones, the lock is only held for the swap
+	rl_mutex_lock(&d->array_mutex);
+	symbol_new = d->symbol1_new;
+	if (symbol_new)
+	{
+		drawcalc_symbol_prep_t *prep_swap = d->symbol_draw;
+		size_t as_swap = d->symbol_draw_as;
+
+		d->symbol_draw = d->symbol1;
+		d->symbol1 = prep_swap;
+		d->symbol_draw_as = d->symbol1_as;
+		d->symbol1_as = as_swap;
+		d->symbol_draw_count = d->symbol1_count;
+		d->symbol1_new = 0;
+	}
+	rl_mutex_unlock(&d->array_mutex);
+
+	// Symbol drawing
+	// Without a GPU the shapes are rasterised by tiles across all cores, numbers and text aren't covered by the tiles so they still go through rouziclib
+	cpu_tiled = fb->use_drawq==0 && fb->r.use_frgb;
+	if (cpu_tiled)
+	{
+		if (drawcalc_cpu_check_on && symbol_new)
+			drawcalc_cpu_check(&cpu_raster, d->symbol_draw, d->symbol_draw_count);
+
+		drawcalc_cpu_render(&cpu_raster, d->symbol_draw, d->symbol_draw_count, fb->r.f, xyi(fb->w, fb->h), drawcalc_view_from_zoom(), 0);
+	}
+	drawcalc_draw_symbols(d->symbol_draw, d->symbol_draw_count, cpu_tiled==0, 1);
+	draw_clamp();
+
+	// Windows
+	window_register(1, drawcalc_compilation_log, NULL, RECTNAN, &comp_log_detached, 1, NULL);
+	window_set_parent(drawcalc_compilation_log, NULL, drawcalc_form, NULL);
+	window_register(1, drawcalc_form, NULL, RECTNAN, &calc_form_detached, 3, &form_string, &form_ret, &comp_log_detached);
+	window_set_parent(drawcalc_form, NULL, drawcalc_window, NULL);
+	window_register(1, drawcalc_var_window, NULL, RECTNAN, &calc_var_detached, 1, d);
+	window_set_parent(drawcalc_var_window, NULL, drawcalc_window, NULL);
+	window_register(1, drawcalc_time_window, NULL, RECTNAN, &calc_time_detached, 1, d);
+	window_set_parent(drawcalc_time_window, NULL, drawcalc_window, NULL);
+
+	window_register(1, drawcalc_window, NULL, RECTNAN, NULL, 6, d, &form_string, &form_ret, &calc_form_detached, &calc_var_detached, &calc_time_detached);
+}
+
+uint64_t drawcalc_hash_data(uint64_t h, const void *data, size_t size)	// FNV-1a
+{
+	const uint8_t *p = data;
+
+	for (size_t i=0; i < size; i++)
+		h = (h ^ p[i]) * 0x100000001B3ULL;
+
+	return h;
+}
+
+// Hashes the symbols field by field (the padding and unused parts of the unions aren't initialised) and counts them by type
+uint64_t drawcalc_symbols_hash(drawcalc_symbol_t *symbol, size_t count, size_t *type_count)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	#define HASH_FIELD(x) h = drawcalc_hash_data(h, &(x), sizeof(x))
+
+	for (size_t is=0; is < count; is++)
+	{
+		drawcalc_symbol_t *sym = &symbol[is];
+		HASH_FIELD(sym->type);
+		if (type_count)
+			type_count[sym->type]++;
+
+		switch (sym->type)
+		{
+			case type_line:		HASH_FIELD(sym->symb.line.col);		HASH_FIELD(sym->symb.line.p0);		HASH_FIELD(sym->symb.line.p1);		HASH_FIELD(sym->symb.line.blur);	break;
+			case type_rect:		HASH_FIELD(sym->symb.rect.col);		HASH_FIELD(sym->symb.rect.rect);					break;
+			case type_quad:		HASH_FIELD(sym->symb.quad.col);		HASH_FIELD(sym->symb.quad.p);		HASH_FIELD(sym->symb.quad.blur);	break;
+			case type_circle:	HASH_FIELD(sym->symb.circle.col);	HASH_FIELD(sym->symb.circle.pos);	HASH_FIELD(sym->symb.circle.radius);	break;
+
+			case type_number:
+				HASH_FIELD(sym->symb.number.col);	HASH_FIELD(sym->symb.number.pos);	HASH_FIELD(sym->symb.number.scale);
+				HASH_FIELD(sym->symb.number.value);	HASH_FIELD(sym->symb.number.prec);	HASH_FIELD(sym->symb.number.alig);
+				break;
+
+			case type_text:
+				HASH_FIELD(sym->symb.text.col);		HASH_FIELD(sym->symb.text.pos);		HASH_FIELD(sym->symb.text.scale);
+				HASH_FIELD(sym->symb.text.v);		HASH_FIELD(sym->symb.text.alig);
+				break;
+		}
+	}
+
+	#undef HASH_FIELD
+	return h;
+}
+
+#define DRAWCALC_HEADLESS_THICKNESS 0.75	// Gaussian edge radius in pixels for headless renders
+
+// Compiles and executes a formula file once with the inputs already set in d, the symbols are left in d->symbol0
+int drawcalc_headless_run(drawcalc_t *d, const char *path, double *t_comp, double *t_exec)
+{
+	buffer_t comp_log={0};
+	rlip_t prog;
+	double t0;
+
+	d->expr_string = (char *) load_raw_file(path, NULL);
+	if (d->expr_string == NULL)
+	{
+		fprintf_rl(stderr, "Couldn't load formula file %s\n", path);
+		return 1;
+	}
+
+	// Compilation
+	t0 = get_time_hr();
+	prog = drawcalc_prog_compile(d, d->expr_string, &comp_log);
+	*t_comp = get_time_hr() - t0;
+	free_null(&d->expr_string);
+	if (drawcalc_comp_failed(&comp_log))
+	{
+		fprintf_rl(stderr, "Compilation log for %s:\n%s\n", path, comp_log.buf);
+		free_buf(&comp_log);
+		free_rlip(&prog);
+		return 1;
+	}
+
+	// Execution, starting from an empty store
+	rlip_store_free();
+	d->thread_on = 1;
+	prog.exec_on = &d->thread_on;
+	t0 = get_time_hr();
+	drawcalc_execute(d, &prog);
+	*t_exec = get_time_hr() - t0;
+	free_rlip(&prog);
+
+	return 0;
+}
+
+void drawcalc_headless_free(drawcalc_t *d)
+{
+	rlip_store_free();
+	free_null(&d->symbol0);
+	d->symbol0_count = d->symbol0_as = 0;
+}
+
+// Describes the symbols in d->symbol0 line by line: count, per type counts, checksum, then the value of each number and the decoded string of each text
+void drawcalc_headless_report(drawcalc_t *d, buffer_t *report)
+{
+	size_t type_count[type_text+1]={0};
+	char string[DRAWCALC_TEXT_MAX_LEN + 1];
+	uint64_t hash;
+	int i;
+
+	hash = drawcalc_symbols_hash(d->symbol0, d->symbol0_count, type_count);
+
+	bufprintf(report, "count\t%zu\n", d->symbol0_count);
+	bufprintf(report, "types");
+	for (i=0; i <= type_text; i++)
+		bufprintf(report, "\t%zu", type_count[i]);
+	bufprintf(report, "\nlimit_hit\t%d\n", d->thread_on==0);
+	bufprintf(report, "checksum\t%016llx\n", (unsigned long long) hash);
+
+	for (size_t is=0; is < d->symbol0_count; is++)
+	{
+		drawcalc_symbol_t *sym = &d->symbol0[is];
+
+		if (sym->type == type_number)
+		{
+			if (isnan(sym->symb.number.value))
+				bufprintf(report, "number\tnan\n");
+			else
+				bufprintf(report, "number\t%.17g\n", sym->symb.number.value);
+		}
+
+		if (sym->type == type_text)
+		{
+			// Control characters are escaped so that each string stays on one line
+			drawcalc_text_decode(sym->symb.text.v, string);
+			bufprintf(report, "text\t\"");
+			for (i=0; string[i]; i++)
+			{
+				switch (string[i])
+				{
+					case '\n':	bufprintf(report, "\\n");	break;
+					case '\t':	bufprintf(report, "\\t");	break;
+					case '\\':	bufprintf(report, "\\\\");	break;
+					case '"':	bufprintf(report, "\\\"");	break;
+					default:	bufprintf(report, "%c", string[i]);
+				}
+			}
+			bufprintf(report, "\"\n");
+		}
+	}
+}
+
+// Renders the symbols in d->symbol0 with the CPU rasteriser and sums the raster, returns how long preparing and rendering took
+double drawcalc_headless_render(drawcalc_t *d, drawcalc_cpu_raster_t *cpu_raster, xyi_t dim, double scale, double sum[3], size_t *nan_count)
+{
+	drawcalc_view_t view;
+	frgb_t *raster = calloc((size_t) dim.x*dim.y, sizeof(frgb_t));
+	drawcalc_symbol_prep_t *symbol_prep = calloc(d->symbol0_count, sizeof(drawcalc_symbol_prep_t));
+	double t0;
+	int i;
+
+	// The world's origin is in the middle of the raster, drawing_thickness is only set up along with a window
+	view.offset = xy(0.5*dim.x, 0.5*dim.y);
+	view.scale = xy(scale, -scale);
+	view.thickness = DRAWCALC_HEADLESS_THICKNESS;
+
+	t0 = get_time_hr();
+	drawcalc_prepare_symbols(symbol_prep, d->symbol0, d->symbol0_count);
+	drawcalc_cpu_render(cpu_raster, symbol_prep, d->symbol0_count, raster, dim, view, 0);
+	t0 = get_time_hr() - t0;
+
+	sum[0] = sum[1] = sum[2] = 0.;
+	*nan_count = 0;
+	for (i=0; i < dim.x*dim.y; i++)
+	{
+		if (isnan(raster[i].r) || isnan(raster[i].g) || isnan(raster[i].b))
+		{
+			(*nan_count)++;
+			continue;
+		}
+
+		sum[0] += raster[i].r;
+		sum[1] += raster[i].g;
+		sum[2] += raster[i].b;
+	}
+
+	free(raster);
+	free(symbol_prep);
+
+	return t0;
+}
+
+// Runs a formula once with fixed inputs and no display, then prints the symbol report and timings
+// Arguments: <formula path> [angle time k0 k1 k2 k3 k4] [-r <width> <height> <pixels per unit>]
+int drawcalc_headless(int argc, char **argv)
+{
+	drawcalc_t *d = &drawcalc;
+	buffer_t report={0};
+	xyi_t render_dim = xyi(0, 0);
+	double render_scale = 0., t0, t_comp, t_exec;
+	int i, ia;
+
+	if (argc < 1)
+	{
+		fprintf_rl(stderr, "Usage: --headless <formula path> [angle time k0 k1 k2 k3 k4] [-r <width> <height> <pixels per unit>]\n");
+		return 1;
+	}
+
+	// Inputs
+	d->angle_v = d->time_v = 0.;
+	for (ia=1; ia < argc; ia++)
+	{
+		if (strcmp(argv[ia], "-r")==0 && ia+3 < argc)
+		{
+			render_dim = xyi(atoi(argv[ia+1]), atoi(argv[ia+2]));
+			render_scale = atof(argv[ia+3]);
+			ia += 3;
+		}
+		else if (ia == 1)
+			d->angle_v = atof(argv[ia]);
+		else if (ia == 2)
+			d->time_v = atof(argv[ia]);
+		else if (ia-3 < sizeof(d->k)/sizeof(*d->k))
+			d->k[ia-3] = atof(argv[ia]);
+	}
+
+	rl_mutex_init(&d->array_mutex);
+
+	if (drawcalc_headless_run(d, argv[0], &t_comp, &t_exec))
+		return 1;
+
+	t0 = get_time_hr();
+	drawcalc_headless_report(d, &report);
+	t0 = get_time_hr() - t0;
+
+	fprintf_rl(stdout, "Compilation %.3f ms, execution %.3f ms, report %.3f ms\n%s", t_comp*1e3, t_exec*1e3, t0*1e3, report.buf);
+	free_buf(&report);
+
+	// CPU rendering
+	if (render_dim.x > 0 && render_dim.y > 0)
+	{
+		drawcalc_cpu_raster_t cpu_raster={0};
+		double sum[3];
+		size_t nan_count;
+
+		t0 = drawcalc_headless_render(d, &cpu_raster, render_dim, render_scale, sum, &nan_count);
+		fprintf_rl(stdout, "Rendered %dx%d in %.3f ms, raster sum %.9g %.9g %.9g, %zu NaN pixels\n", render_dim.x, render_dim.y, t0*1e3, sum[0], sum[1], sum[2], nan_count);
+		drawcalc_cpu_raster_free(&cpu_raster);
+	}
+
+	drawcalc_headless_free(d);
+
+	return 0;
+}
+
+// Regression suite: <dir>/cases.txt lists case names, each case is a formula <name>.rlip and its expectations <name>.expected
+// An expectations file has an "inputs" line (angle time k0 k1 k2 k3 k4), an optional "render" line (width height pixels per unit),
+// budget lines in milliseconds for compilation, execution and rendering, a "raster_sum" line compared within DRAWCALC_SUITE_SUM_TOL
+// and lines of drawcalc_headless_report() that the run must reproduce exactly. Report lines whose key doesn't appear in the file
+// aren't compared, so a hand written file can check only some keys until it's blessed. Lines starting with # are comments
+#define DRAWCALC_SUITE_RUNS 3			// the fastest run of each phase is the one compared to its budget
+#define DRAWCALC_SUITE_BUDGET_MARGIN 3.		// blessed budgets are 3 times the measured time
+#define DRAWCALC_SUITE_BUDGET_MIN_MS 1.		// but at least 1 ms so that the timer's resolution and scheduling can't fail a case
+#define DRAWCALC_SUITE_SUM_TOL 1e-5		// relative tolerance of the raster sum, for compilers that round the kernels differently
+
+char *drawcalc_suite_next_line(char **p)	// cuts the next line out of the text, NULL at the end
+{
+	char *line = *p, *end;
+
+	if (line == NULL || line[0] == '\0')
+		return NULL;
+
+	end = strchr(line, '\n');
+	if (end)
+	{
+		*end = '\0';
+		*p = end + 1;
+	}
+	else
+		*p = &line[strlen(line)];
+
+	if (line[0] && line[strlen(line)-1] == '\r')
+		line[strlen(line)-1] = '\0';
+
+	return line;
+}
+
+int drawcalc_suite_has_key(const char *lines, const char *line)	// 1 if one of the lines starts with the same key (the part before the tab) as line
+{
+	size_t key_len = strcspn(line, "\t");
+
+	while (lines && lines[0])
+	{
+		if (strncmp(lines, line, key_len)==0 && lines[key_len] == '\t')
+			return 1;
+
+		lines = strchr(lines, '\n');
+		if (lines)
+			lines++;
+	}
+
+	return 0;
+}
+
+double drawcalc_suite_budget(double t)	// blessed budget in ms for a measured time in seconds
+{
+	return MAXN(DRAWCALC_SUITE_BUDGET_MIN_MS, ceil(t*1e3 * DRAWCALC_SUITE_BUDGET_MARGIN * 10.) / 10.);
+}
+
+// Returns 0 if the case matched its expectations, with bless the expectations file is rewritten from the results instead
+int drawcalc_suite_case(drawcalc_t *d, drawcalc_cpu_raster_t *cpu_raster, const char *dir, const char *name, int bless)
+{
+	char path[1024], *expected_file, *p, *line, *report_line;
+	buffer_t comments={0}, expected={0}, report={0}, report0={0};
+	double budget[3]={NAN, NAN, NAN}, t[3], t_best[3]={INFINITY, INFINITY, INFINITY}, input[7]={0};
+	double render_scale=0., sum[3]={0}, sum0[3]={0}, sum_exp[3]={NAN, NAN, NAN};
+	const char *phase_name[] = {"compilation", "execution", "rendering"}, *budget_key[] = {"budget_comp_ms", "budget_exec_ms", "budget_render_ms"};
+	xyi_t render_dim = xyi(0, 0);
+	size_t nan_count;
+	int i, ip, ret=0, have_inputs=0, line_num, phase_count;
+	FILE *file;
+
+	snprintf(path, sizeof(path), "%s/%s.expected", dir, name);
+	expected_file = (char *) load_raw_file(path, NULL);
+	if (expected_file == NULL)
+	{
+		fprintf_rl(stderr, "%s: couldn't load %s\n", name, path);
+		return 1;
+	}
+
+	// Parse the expectations
+	p = expected_file;
+	while ((line = drawcalc_suite_next_line(&p)))
+	{
+		if (line[0] == '#' || line[0] == '\0')
+		{
+			bufprintf(&comments, "%s\n", line);
+			continue;
+		}
+
+		if (strncmp(line, "inputs\t", 7)==0)
+			have_inputs = sscanf(&line[7], "%lg %lg %lg %lg %lg %lg %lg", &input[0], &input[1], &input[2], &input[3], &input[4], &input[5], &input[6]) == 7;
+		else if (strncmp(line, "render\t", 7)==0)
+			sscanf(&line[7], "%d %d %lg", &render_dim.x, &render_dim.y, &render_scale);
+		else if (strncmp(line, "raster_sum\t", 11)==0)
+			sscanf(&line[11], "%lg %lg %lg", &sum_exp[0], &sum_exp[1], &sum_exp[2]);
+		else
+		{
+			for (ip=0; ip < 3; ip++)
+				if (strncmp(line, budget_key[ip], strlen(budget_key[ip]))==0 && line[strlen(budget_key[ip])] == '\t')
+					break;
+
+			if (ip < 3)
+				budget[ip] = atof(&line[strlen(budget_key[ip])+1]);
+			else
+				bufprintf(&expected, "%s\n", line);
+		}
+	}
+	free(expected_file);
+
+	if (have_inputs == 0)
+	{
+		fprintf_rl(stderr, "%s: the inputs line is missing or doesn't have 7 values\n", name);
+		free_buf(&comments);
+		free_buf(&expected);
+		return 1;
+	}
+	phase_count = render_dim.x > 0 && render_dim.y > 0 ? 3 : 2;
+
+	// Runs
+	snprintf(path, sizeof(path), "%s/%s.rlip", dir, name);
+	for (i=0; i < DRAWCALC_SUITE_RUNS; i++)
+	{
+		d->angle_v = input[0];
+		d->time_v = input[1];
+		memcpy(d->k, &input[2], sizeof(d->k));
+
+		if (drawcalc_headless_run(d, path, &t[0], &t[1]))
+		{
+			ret = 1;
+			goto end;
+		}
+
+		drawcalc_headless_report(d, &report);
+		if (phase_count == 3)
+		{
+			t[2] = drawcalc_headless_render(d, cpu_raster, render_dim, render_scale, sum, &nan_count);
+			bufprintf(&report, "raster_nan\t%zu\n", nan_count);
+		}
+
+		for (ip=0; ip < phase_count; ip++)
+			t_best[ip] = MINN(t_best[ip], t[ip]);
+
+		if (i == 0)
+		{
+			report0 = report;
+			memset(&report, 0, sizeof(report));
+			memcpy(sum0, sum, sizeof(sum0));
+		}
+		else
+		{
+			// Each run must give the same symbols and the same raster
+			if (strcmp((char *) report.buf, (char *) report0.buf) || (phase_count == 3 && memcmp(sum, sum0, sizeof(sum0))))
+			{
+				fprintf_rl(stderr, "%s: run %d gave different results than the first run\n", name, i+1);
+				ret = 1;
+			}
+			free_buf(&report);
+		}
+		drawcalc_headless_free(d);
+	}
+
+	if (bless)
+	{
+		// Budgets are set from the measured times every time
+		snprintf(path, sizeof(path), "%s/%s.expected", dir, name);
+		file = fopen_utf8(path, "wb");
+		if (file == NULL)
+		{
+			fprintf_rl(stderr, "%s: couldn't write %s\n", name, path);
+			ret = 1;
+			goto end;
+		}
+
+		fprintf(file, "%sinputs\t%.17g %.17g %.17g %.17g %.17g %.17g %.17g\n", comments.buf ? comments.buf : "",
+				input[0], input[1], input[2], input[3], input[4], input[5], input[6]);
+		if (phase_count == 3)
+			fprintf(file, "render\t%d %d %.17g\n", render_dim.x, render_dim.y, render_scale);
+		for (ip=0; ip < phase_count; ip++)
+			fprintf(file, "%s\t%g\n", budget_key[ip], drawcalc_suite_budget(t_best[ip]));
+		fprintf(file, "%s", report0.buf);
+		if (phase_count == 3)
+			fprintf(file, "raster_sum\t%.9g %.9g %.9g\n", sum0[0], sum0[1], sum0[2]);
+		fclose(file);
+
+		fprintf_rl(stdout, "%s: blessed, compilation %.3f ms, execution %.3f ms", name, t_best[0]*1e3, t_best[1]*1e3);
+		if (phase_count == 3)
+			fprintf_rl(stdout, ", rendering %.3f ms", t_best[2]*1e3);
+		fprintf_rl(stdout, "\n");
+		goto end;
+	}
+
+	// Leave out report lines that have no expectation
+	report_line = (char *) report0.buf;
+	while ((line = drawcalc_suite_next_line(&report_line)))
+		if (drawcalc_suite_has_key((char *) expected.buf, line))
+			bufprintf(&report, "%s\n", line);
+
+	// Compare line by line
+	p = (char *) expected.buf;
+	report_line = (char *) report.buf;
+	for (line_num=1; ; line_num++)
+	{
+		char *a = drawcalc_suite_next_line(&p);
+		char *b = drawcalc_suite_next_line(&report_line);
+
+		if (a == NULL && b == NULL)
+			break;
+
+		if (a == NULL || b == NULL || strcmp(a, b))
+		{
+			fprintf_rl(stderr, "%s: result line %d is\n\t%s\nbut should be\n\t%s\n", name, line_num, b ? b : "(nothing)", a ? a : "(nothing)");
+			ret = 1;
+			break;
+		}
+	}
+
+	if (phase_count == 3)
+	{
+		if (isnan(sum_exp[0]) || isnan(sum_exp[1]) || isnan(sum_exp[2]))
+		{
+			fprintf_rl(stderr, "%s: the raster_sum line is missing, bless the case with --suite %s --bless\n", name, dir);
+			ret = 1;
+		}
+		else for (ip=0; ip < 3; ip++)
+			if (fabs(sum0[ip] - sum_exp[ip]) > DRAWCALC_SUITE_SUM_TOL * MAXN(fabs(sum_exp[ip]), 1.))
+			{
+				fprintf_rl(stderr, "%s: raster sum is %.9g %.9g %.9g but should be %.9g %.9g %.9g\n", name, sum0[0], sum0[1], sum0[2], sum_exp[0], sum_exp[1], sum_exp[2]);
+				ret = 1;
+				break;
+			}
+	}
+
+	for (ip=0; ip < phase_count; ip++)
+	{
+		if (isnan(budget[ip]))
+		{
+			fprintf_rl(stderr, "%s: the %s line is missing, bless the case with --suite %s --bless\n", name, budget_key[ip], dir);
+			ret = 1;
+		}
+		else if (t_best[ip]*1e3 > budget[ip])
+		{
+			fprintf_rl(stderr, "%s: %s took %.3f ms, over its budget of %g ms\n", name, phase_name[ip], t_best[ip]*1e3, budget[ip]);
+			ret = 1;
+		}
+	}
+
+	fprintf_rl(stdout, "%s: %s, compilation %.3f / %g ms, execution %.3f / %g ms", name, ret ? "FAIL" : "pass", t_best[0]*1e3, budget[0], t_best[1]*1e3, budget[1]);
+	if (phase_count == 3)
+		fprintf_rl(stdout, ", rendering %.3f / %g ms", t_best[2]*1e3, budget[2]);
+	fprintf_rl(stdout, "\n");
+
+end:
+	drawcalc_headless_free(d);
+	free_buf(&comments);
+	free_buf(&expected);
+	free_buf(&report);
+	free_buf(&report0);
+	return ret;
+}
+
+// Arguments: <suite dir> [--bless], returns the number of failed cases
+int drawcalc_suite(int argc, char **argv)
+{
+	drawcalc_t *d = &drawcalc;
+	drawcalc_cpu_raster_t cpu_raster={0};
+	char path[1024], *list, *p, *name;
+	int bless, fail_count=0, case_count=0;
+
+	if (argc < 1)
+	{
+		fprintf_rl(stderr, "Usage: --suite <suite dir> [--bless]\n");
+		return 1;
+	}
+	bless = argc > 1 && strcmp(argv[1], "--bless")==0;
+
+	snprintf(path, sizeof(path), "%s/cases.txt", argv[0]);
+	list = (char *) load_raw_file(path, NULL);
+	if (list == NULL)
+	{
+		fprintf_rl(stderr, "Couldn't load case list %s\n", path);
+		return 1;
+	}
+
+	rl_mutex_init(&d->array_mutex);
+
+	p = list;
+	while ((name = drawcalc_suite_next_line(&p)))
+	{
+		if (name[0] == '#' || name[0] == '\0')
+			continue;
+
+		fail_count += drawcalc_suite_case(d, &cpu_raster, argv[0], name, bless);
+		case_count++;
+	}
+	free(list);
+	drawcalc_cpu_raster_free(&cpu_raster);
+
+	fprintf_rl(stdout, "%d out of %d cases %s\n", case_count-fail_count, case_count, bless ? "blessed" : "passed");
+
+	return fail_count;
+}
+
+#ifndef DRAWCALC_AS_A_LIBRARY
+void main_loop()
+{
+	sdl_main_param_t param={0};
+	param.window_name = "Drawing Calculator";
+	param.func = drawing_calculator;
+	param.use_drawq = drawcalc_cpu_check_on==0;
+	param.maximise_window = 1;
+	param.gui_toolbar = 1;
+	rl_sdl_standard_main_loop(param);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--headless")==0)
+		return drawcalc_headless(argc-2, &argv[2]);
+
+	if (argc > 1 && strcmp(argv[1], "--suite")==0)
+		return drawcalc_suite(argc-2, &argv[2]) != 0;
+
+	// Software rendering that compares the tiled rasteriser with rouziclib on every new set of symbols
+	if (argc > 1 && strcmp(argv[1], "--cpu-check")==0)
+		drawcalc_cpu_check_on = 1;
+
 	#ifdef __EMSCRIPTEN__
 	emscripten_set_main_loop(main_loop, 0, 1);
 	#else